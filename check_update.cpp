@@ -0,0 +1,180 @@
+/**
+ * a harness for the turn resolution of rps.cpp. It plays free-for-all turns with
+ * one order for every unit and checks that resolving them in parallel parts
+ * gives the same world as resolving them in a single part.
+ * Build: g++ -std=c++17 -O2 -pthread check_update.cpp -o check_update
+ */
+#define RPS_NO_MAIN
+#include "rps.cpp"
+
+int failures=0;
+
+void check(bool ok,string what) {
+    if (!ok) {
+        cout<<"FAILED: "<<what<<"\n";
+        failures++;
+    }
+}
+
+/**
+ * put a unit on the board of a world made for the test
+ */
+void put(World& world,Owner o,Type t,Position p) {
+    world.units[o].push_back(std::make_shared<Piece<char>>(Piece<char>(t,o,'x',p)));
+    world.grid.set(p,world.units[o].back());
+}
+
+/**
+ * @return bool true if both worlds have the same players, units and squares
+ */
+bool same(World& a,World& b) {
+    if (a.alive!=b.alive || a.grid.chunkCount()!=b.grid.chunkCount()) return false;
+    for (Owner o=0;o<a.players;o++) {
+        if (a.units[o].size()!=b.units[o].size()) return false;
+        for (size_t i=0;i<a.units[o].size();i++) {
+            Position p=a.units[o][i]->getPos();
+            if (!(p==b.units[o][i]->getPos())) return false;
+            if (a.units[o][i]->getType()!=b.units[o][i]->getType()) return false;
+            if (a.grid.at(p)!=a.units[o][i] || b.grid.at(p)!=b.units[o][i]) return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * the rules of the fights that don't depend on the number of parts
+ */
+void checkRules() {
+    bool tie=false;
+    World w(3,40,40,0,1);
+    // a stronger attacker takes the square from a weaker one
+    put(w,ZERO,PAPER,Position(19,20));
+    put(w,ONE,ROCK,Position(21,20));
+    update(w,{{ZERO,Action(Position(19,20),Position(20,20))},{ONE,Action(Position(21,20),Position(20,20))}},tie);
+    check(w.units[ONE].empty() && w.units[ZERO].size()==1 && w.units[ZERO][0]->getPos()==Position(20,20),
+          "two-way collision");
+    // rock kills scissors
+    put(w,ONE,SCISSORS,Position(5,5));
+    put(w,ZERO,ROCK,Position(5,6));
+    update(w,{{ZERO,Action(Position(5,6),Position(5,5))}},tie);
+    check(w.grid.at(Position(5,5))->getType()==ROCK && w.units[ONE].empty(),"rock against scissors");
+    w.units[ZERO].pop_back();
+    w.grid.set(Position(5,5),NULL);
+    // three types on the same square kill each other
+    put(w,ZERO,ROCK,Position(9,10));
+    put(w,ONE,PAPER,Position(11,10));
+    put(w,2,SCISSORS,Position(10,9));
+    update(w,{{ZERO,Action(Position(9,10),Position(10,10))},{ONE,Action(Position(11,10),Position(10,10))},
+              {2,Action(Position(10,9),Position(10,10))}},tie);
+    check(w.grid.at(Position(10,10))==NULL && w.units[2].empty() && w.units[ONE].empty(),"three-way collision");
+    // two units of the same type swapping squares bounce back
+    put(w,ONE,PAPER,Position(20,21));
+    update(w,{{ZERO,Action(Position(20,20),Position(20,21))},{ONE,Action(Position(20,21),Position(20,20))}},tie);
+    check(w.grid.at(Position(20,20))->getOwner()==ZERO && w.grid.at(Position(20,21))->getOwner()==ONE,
+          "swap of the same type");
+}
+
+/**
+ * a board of three players with nothing on it
+ */
+World emptyBoard() {
+    World world(3,40,40,0,1);
+    for (Position flag : world.flags) {
+        world.grid.set(flag,NULL);
+    }
+    return world;
+}
+
+/**
+ * the occupant of a square only defends it if it stays there
+ */
+void checkChains() {
+    bool tie=false;
+    // a unit that moves away is not caught by a stronger chaser
+    World w=emptyBoard();
+    put(w,ZERO,PAPER,Position(10,10));
+    put(w,ONE,SCISSORS,Position(11,10));
+    update(w,{{ZERO,Action(Position(10,10),Position(9,10))},{ONE,Action(Position(11,10),Position(10,10))}},tie);
+    check(w.grid.at(Position(9,10))==w.units[ZERO][0] && w.grid.at(Position(10,10))==w.units[ONE][0],
+          "moving away from a stronger chaser");
+    // a weaker chaser follows into the square that was left
+    w=emptyBoard();
+    put(w,ZERO,PAPER,Position(10,10));
+    put(w,ONE,ROCK,Position(11,10));
+    update(w,{{ZERO,Action(Position(10,10),Position(9,10))},{ONE,Action(Position(11,10),Position(10,10))}},tie);
+    check(w.grid.at(Position(9,10))==w.units[ZERO][0] && w.grid.at(Position(10,10))==w.units[ONE][0],
+          "a weaker chaser follows");
+    // two units of the same type walking in a line both move
+    w=emptyBoard();
+    put(w,ZERO,ROCK,Position(10,10));
+    put(w,ONE,ROCK,Position(11,10));
+    update(w,{{ZERO,Action(Position(10,10),Position(9,10))},{ONE,Action(Position(11,10),Position(10,10))}},tie);
+    check(w.grid.at(Position(9,10))==w.units[ZERO][0] && w.grid.at(Position(10,10))==w.units[ONE][0],
+          "same type in a line");
+    // the front unit bounces, so the one following it fights it where it stays
+    w=emptyBoard();
+    put(w,2,ROCK,Position(9,10));
+    put(w,ZERO,ROCK,Position(10,10));
+    put(w,ONE,SCISSORS,Position(11,10));
+    update(w,{{ZERO,Action(Position(10,10),Position(9,10))},{ONE,Action(Position(11,10),Position(10,10))}},tie);
+    check(w.grid.at(Position(10,10))==w.units[ZERO][0] && w.units[ONE].empty() && w.units[2].size()==1,
+          "following a unit that bounces");
+    // the front unit is killed where it goes, so the one following it gets in
+    w=emptyBoard();
+    put(w,2,SCISSORS,Position(9,10));
+    put(w,ZERO,PAPER,Position(10,10));
+    put(w,ONE,ROCK,Position(11,10));
+    update(w,{{ZERO,Action(Position(10,10),Position(9,10))},{ONE,Action(Position(11,10),Position(10,10))}},tie);
+    check(w.units[ZERO].empty() && w.grid.at(Position(10,10))==w.units[ONE][0],"following a unit that dies");
+    // a closed ring of units all move
+    w=emptyBoard();
+    put(w,ZERO,ROCK,Position(30,30));
+    put(w,ONE,ROCK,Position(30,31));
+    put(w,ZERO,ROCK,Position(31,31));
+    put(w,ONE,ROCK,Position(31,30));
+    update(w,{{ZERO,Action(Position(30,30),Position(30,31))},{ONE,Action(Position(30,31),Position(31,31))},
+              {ZERO,Action(Position(31,31),Position(31,30))},{ONE,Action(Position(31,30),Position(30,30))}},tie);
+    check(w.units[ZERO][0]->getPos()==Position(30,31) && w.units[ONE][0]->getPos()==Position(31,31) &&
+          w.units[ZERO][1]->getPos()==Position(31,30) && w.units[ONE][1]->getPos()==Position(30,30),"ring");
+}
+
+/**
+ * play turns on two copies of the same world, one resolved in parallel parts and
+ * one in a single part, and compare them after every turn
+ */
+void checkParallel(unsigned seed) {
+    World parallel(40,2000,2000,1000,seed);
+    World single(40,2000,2000,1000,seed);
+    mt19937 gen(seed);
+    size_t most=0;
+    for (int turn=0;turn<20;turn++) {
+        vector<tuple<Owner,Action>> orders;
+        for (Owner o=0;o<parallel.players;o++) {
+            for (auto& unit : parallel.units[o]) {
+                vector<Position> directories=freeSquares(parallel,o,unit->getPos());
+                if (directories.size()==0) continue;
+                orders.push_back({o,Action(unit->getPos(),directories[gen()%directories.size()])});
+            }
+        }
+        most=max(most,orders.size());
+        bool tie0=false,tie1=false;
+        update(parallel,orders,tie0,8);
+        update(single,orders,tie1,1);
+        if (!same(parallel,single)) {
+            check(false,"parallel and single part differ, seed "+to_string(seed)+" turn "+to_string(turn));
+            return;
+        }
+    }
+    cout<<"seed "<<seed<<": up to "<<most<<" orders a turn\n";
+}
+
+int main() {
+    checkRules();
+    checkChains();
+    for (unsigned seed=1;seed<=3;seed++) {
+        checkParallel(seed);
+    }
+    if (failures) return 1;
+    cout<<"ok\n";
+    return 0;
+}
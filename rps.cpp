@@ -3,8 +3,17 @@
 #include <thread>
 #include <chrono>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <functional>
+#include <string>
 #include <vector>
 #include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cctype>
+#include <climits>
 #include <time.h>
 #include <algorithm>
 
@@ -19,13 +28,18 @@ enum Type{
 };
 
 const int TIMEOUT = 400; // maximum number of milliseconds that a player is allowed to take
+const int CHUNK = 16; // the side of a square chunk of the board
+const int PARALLEL_ORDERS = 4096; // with fewer orders resolve() runs only on the calling thread
+const int SHOW_LIMIT = 60; // bigger boards are shown as a summary instead of a grid
 
 /**
- * an enumeration to determine the owner of the piece
+ * the owner of the piece: the index of a player starting from ZERO,
+ * or NA for the pieces that nobody owns
  */
-enum Owner{
-    ZERO,ONE,NA
-};
+typedef int Owner;
+const Owner ZERO=0;
+const Owner ONE=1;
+const Owner NA=-1;
 
 
 /** a class to give the position of a piece in a tuple
@@ -40,7 +54,7 @@ public:
     }
     int getAt(int i) const {
         if (i==0) return get<0>(pos);
-        if (i==1) return get<1>(pos);
+        return get<1>(pos);
     }
     friend bool operator==(const Position &p1,const Position &p2);
     friend bool operator<(const Position &p1,const Position &p2);
@@ -116,28 +130,121 @@ public:
     Position getTo() {
         return to;
     }
-    Position setFrom(Position f) {
+    void setFrom(Position f) {
         this->from=f;
     }
-    Position setTo(Position t) {
+    void setTo(Position t) {
         this->to=t;
     }
 };
 
+/**
+ * the board of the game split into CHUNK x CHUNK squares. A chunk is allocated
+ * only while some unit lies inside it, so the memory follows the number of
+ * pieces and not the area of the board. Mountains and flags never move and are
+ * scattered over the whole board, so they are kept one by one in a hash map
+ * instead of pinning a chunk each. Reading never allocates, so many threads
+ * may read the grid at the same time as long as nobody writes to it.
+ */
+class Grid {
+private:
+    class Chunk {
+    public:
+        shared_ptr<Piece<char>> cells[CHUNK*CHUNK];
+        int count=0;
+    };
+    unordered_map<unsigned long long,unique_ptr<Chunk>> chunks;
+    unordered_map<unsigned long long,shared_ptr<Piece<char>>> fixed;
+    // round down so that the positions outside the board get their own chunks
+    static int chunkIndex(int x) {
+        return x>=0 ? x/CHUNK : -((-x+CHUNK-1)/CHUNK);
+    }
+    static int cellOf(Position p) {
+        int r=p.getAt(0)-chunkIndex(p.getAt(0))*CHUNK;
+        int c=p.getAt(1)-chunkIndex(p.getAt(1))*CHUNK;
+        return r*CHUNK+c;
+    }
+    static unsigned long long keyOf(int r,int c) {
+        return ((unsigned long long)(unsigned int)r<<32) | (unsigned int)c;
+    }
+public:
+    /**
+     * @return unsigned long long the key of the chunk that contains the position
+     */
+    static unsigned long long chunkOf(Position p) {
+        return keyOf(chunkIndex(p.getAt(0)),chunkIndex(p.getAt(1)));
+    }
+    /**
+     * @return the piece at the position or NULL if the square is empty
+     */
+    shared_ptr<Piece<char>> at(Position p) const {
+        auto it=chunks.find(chunkOf(p));
+        if (it!=chunks.end() && it->second->cells[cellOf(p)]!=NULL) {
+            return it->second->cells[cellOf(p)];
+        }
+        auto f=fixed.find(keyOf(p.getAt(0),p.getAt(1)));
+        if (f==fixed.end()) return NULL;
+        return f->second;
+    }
+    /**
+     * put a piece that never moves, like a mountain or a flag, at the position
+     */
+    void fix(Position p,shared_ptr<Piece<char>> piece) {
+        fixed[keyOf(p.getAt(0),p.getAt(1))]=piece;
+    }
+    /**
+     * put a unit at the position, NULL empties the square
+     */
+    void set(Position p,shared_ptr<Piece<char>> piece) {
+        unsigned long long key=chunkOf(p);
+        auto it=chunks.find(key);
+        if (piece==NULL) {
+            fixed.erase(keyOf(p.getAt(0),p.getAt(1)));
+            if (it==chunks.end()) return;
+            shared_ptr<Piece<char>> &cell=it->second->cells[cellOf(p)];
+            if (cell==NULL) return;
+            cell=NULL;
+            // free the chunk once its last unit leaves
+            if (--it->second->count==0) chunks.erase(it);
+            return;
+        }
+        if (it==chunks.end()) it=chunks.emplace(key,make_unique<Chunk>()).first;
+        shared_ptr<Piece<char>> &cell=it->second->cells[cellOf(p)];
+        if (cell==NULL) it->second->count++;
+        cell=piece;
+    }
+    /**
+     * @return size_t the number of allocated chunks
+     */
+    size_t chunkCount() const {
+        return chunks.size();
+    }
+};
+
 /** the world that contains all the objects and pieces used in the world
  */
 class World {
 public:
+    int players;
+    int rows;
+    int cols;
     // ITEM 3.b shared pointers because there will be more than one,
-    // one pointing in the map and one in the vector for each object
+    // one pointing in the grid and one in the vector for each object
     vector<shared_ptr<Piece<char>>> mountains;
-    // ITEM 1.1.a ITEM 1.1.b ITEM 3.a.1
-    vector<shared_ptr<Piece<char>>> units0;
-    vector<shared_ptr<Piece<char>>> units1;
-    map<Position,shared_ptr<Piece<char>>> grid;
+    // ITEM 1.1.a ITEM 1.1.b ITEM 3.a.1 the units of each player by owner
+    vector<vector<shared_ptr<Piece<char>>>> units;
+    vector<Position> flags;
+    // false for the players that are out of the game
+    vector<bool> alive;
+    Grid grid;
 
     World() {
         // ITEM 1.2 ITEM 3.a.2 this constructor contains the initial setup
+        players=2;
+        rows=15;
+        cols=15;
+        units.resize(players);
+        alive.assign(players,true);
         // the map of the mountains
         bool m[15][15] = {
             {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0},
@@ -160,8 +267,8 @@ public:
             for (int j=0;j<15;j++) {
                 if (m[i][j]) {
                     Position p(i+1,j+1);
-                    grid[p]=std::make_shared<Piece<char>>(Piece<char>(MOUNT,NA,'M',p));
-                    mountains.push_back(grid[p]);
+                    mountains.push_back(std::make_shared<Piece<char>>(Piece<char>(MOUNT,NA,'M',p)));
+                    grid.fix(p,mountains.back());
                 }
             }
         }
@@ -171,15 +278,15 @@ public:
                 Position p(i,j);
                 if (i>6 || j>6) continue;
                 if (i%3==0) {
-                    grid[p]=std::make_shared<Piece<char>>(Piece<char>(SCISSORS,ZERO,'s',p));
+                    units[ZERO].push_back(std::make_shared<Piece<char>>(Piece<char>(SCISSORS,ZERO,'s',p)));
                 }
                 if (i%3==1) {
-                    grid[p]=std::make_shared<Piece<char>>(Piece<char>(ROCK,ZERO,'r',p));
+                    units[ZERO].push_back(std::make_shared<Piece<char>>(Piece<char>(ROCK,ZERO,'r',p)));
                 }
                 if (i%3==2) {
-                    grid[p]=std::make_shared<Piece<char>>(Piece<char>(PAPER,ZERO,'p',p));
+                    units[ZERO].push_back(std::make_shared<Piece<char>>(Piece<char>(PAPER,ZERO,'p',p)));
                 }
-                units0.push_back(grid[p]);
+                grid.set(p,units[ZERO].back());
             }
         }
         // add units of player one
@@ -190,32 +297,101 @@ public:
                 int jj=15-j+1;
                 Position p(ii,jj);
                 if (i%3==0) {
-                    grid[p]=std::make_shared<Piece<char>>(Piece<char>(SCISSORS,ONE,'S',p));
+                    units[ONE].push_back(std::make_shared<Piece<char>>(Piece<char>(SCISSORS,ONE,'S',p)));
                 }
                 if (i%3==1) {
-                    grid[p]=std::make_shared<Piece<char>>(Piece<char>(ROCK,ONE,'R',p));
+                    units[ONE].push_back(std::make_shared<Piece<char>>(Piece<char>(ROCK,ONE,'R',p)));
                 }
                 if (i%3==2) {
-                    grid[p]=std::make_shared<Piece<char>>(Piece<char>(PAPER,ONE,'P',p));
+                    units[ONE].push_back(std::make_shared<Piece<char>>(Piece<char>(PAPER,ONE,'P',p)));
                 }
-                units1.push_back(grid[p]);
+                grid.set(p,units[ONE].back());
             }
         }
         // add flags
         Position fPos(1,1);
         Position FPos(15,15);
-        grid[fPos]=std::make_shared<Piece<char>>(Piece<char>(FLAG,ZERO,'f',fPos));
-        grid[FPos]=std::make_shared<Piece<char>>(Piece<char>(FLAG,ONE,'F',FPos));
+        flags={fPos,FPos};
+        grid.fix(fPos,std::make_shared<Piece<char>>(Piece<char>(FLAG,ZERO,'f',fPos)));
+        grid.fix(FPos,std::make_shared<Piece<char>>(Piece<char>(FLAG,ONE,'F',FPos)));
     }
-    //show the grid
+
+    /**
+     * a free-for-all setup: every player gets a flag at a random square and its
+     * units are scattered around it, then mountains are scattered over the board
+     * @param n int the number of players
+     * @param r int the number of rows
+     * @param c int the number of columns
+     * @param unitsPerPlayer int
+     * @param seed unsigned so that a setup can be replayed
+     */
+    World(int n,int r,int c,int unitsPerPlayer,unsigned seed) {
+        players=n;
+        rows=r;
+        cols=c;
+        units.resize(players);
+        alive.assign(players,true);
+        mt19937 gen(seed);
+        uniform_int_distribution<int> row(1,rows),col(1,cols);
+        for (Owner o=0;o<players;o++) {
+            Position p;
+            do {
+                p=Position(row(gen),col(gen));
+            } while (grid.at(p)!=NULL);
+            flags.push_back(p);
+            grid.fix(p,std::make_shared<Piece<char>>(Piece<char>(FLAG,o,o==ZERO ? 'f' : 'F',p)));
+        }
+        // the units of a player fill about a quarter of a square around its flag
+        int half=(int)sqrt(unitsPerPlayer)+1;
+        uniform_int_distribution<int> shift(-half,half);
+        const char names[]={'r','p','s'};
+        for (Owner o=0;o<players;o++) {
+            for (int i=0,tries=0;i<unitsPerPlayer && tries<100*unitsPerPlayer;tries++) {
+                Position p(flags[o].getAt(0)+shift(gen),flags[o].getAt(1)+shift(gen));
+                if (!inside(p) || grid.at(p)!=NULL) continue;
+                char name=o==ZERO ? names[i%3] : toupper(names[i%3]);
+                units[o].push_back(std::make_shared<Piece<char>>(Piece<char>(Type(i%3),o,name,p)));
+                grid.set(p,units[o].back());
+                i++;
+            }
+        }
+        // a mountain for every four units
+        int total=players*unitsPerPlayer/4;
+        for (int i=0,tries=0;i<total && tries<100*total;tries++) {
+            Position p(row(gen),col(gen));
+            if (grid.at(p)!=NULL) continue;
+            mountains.push_back(std::make_shared<Piece<char>>(Piece<char>(MOUNT,NA,'M',p)));
+            grid.fix(p,mountains.back());
+            i++;
+        }
+    }
+
+    /**
+     * @return bool true if the position is on the board
+     */
+    bool inside(Position p) const {
+        return p.getAt(0)>=1 && p.getAt(0)<=rows &&
+               p.getAt(1)>=1 && p.getAt(1)<=cols;
+    }
+
+    //show the grid, or how many units each player has left when the board is too big to print
+    //or when there are more players than the two cases of the letters can tell apart
     void show() {
-        for (int i=1;i<=15;i++) {
-            for (int j=1;j<=15;j++) {
+        if (players>2 || rows>SHOW_LIMIT || cols>SHOW_LIMIT) {
+            for (Owner o=0;o<players;o++) {
+                if (!alive[o]) continue;
+                cout<<"Player "<<o<<": "<<units[o].size()<<" units\n";
+            }
+            cout<<endl;
+            return;
+        }
+        for (int i=1;i<=rows;i++) {
+            for (int j=1;j<=cols;j++) {
                 Position p(i,j);
-                if (grid[p]==NULL)
+                if (grid.at(p)==NULL)
                     cout<<". ";
                 else
-                    cout<<grid[p]->getVal()<<' ';
+                    cout<<grid.at(p)->getVal()<<' ';
             }
             cout<<endl;
         }
@@ -224,58 +400,104 @@ public:
 };
 
 /**
- * the strategy of this player is random. It chooses the last piece of his pieces and
- * and checks the possible directions and picks one randomly.
- * @param world World& the given world
- * @return Action the chosen action
- * ITEM 3.c the random guy
+ * @return string the name of the player used in the messages
+ */
+string playerName(Owner o) {
+    if (o==ZERO) return "zero";
+    if (o==ONE) return "one";
+    return to_string(o);
+}
+
+/**
+ * the squares next to a position where a unit of the owner may move
+ * @param world World&
+ * @param owner Owner
+ * @param p Position of the unit
+ * @return vector<Position>
  */
-Action actionPlayerZero(World& world) {
-    if (world.units0.size()==0) return Action(Position(1,1),Position(1,1));
-    shared_ptr<Piece<char>> chosen = world.units0[world.units0.size()-1];
+vector<Position> freeSquares(World& world, Owner owner, Position p) {
     vector<Position> directories;
-    Position p=chosen->getPos();
     int dir[]={-1,1};
     for (int i=0;i<2;i++) {
         Position newPosition(p.getAt(0)+dir[i],p.getAt(1));
-        if (world.grid[newPosition]==NULL)
+        if (!world.inside(newPosition)) continue;
+        if (world.grid.at(newPosition)==NULL)
             directories.push_back(newPosition);
-        else if (world.grid[newPosition]->getOwner()!=ZERO &&
-                 world.grid[newPosition]->getType()!=MOUNT)
+        else if (world.grid.at(newPosition)->getOwner()!=owner &&
+                 world.grid.at(newPosition)->getType()!=MOUNT)
             directories.push_back(newPosition);
     }
     for (int i=0;i<2;i++) {
         Position newPosition(p.getAt(0),p.getAt(1)+dir[i]);
-        if (world.grid[newPosition]==NULL)
+        if (!world.inside(newPosition)) continue;
+        if (world.grid.at(newPosition)==NULL)
             directories.push_back(newPosition);
-        else if (world.grid[newPosition]->getOwner()!=ZERO &&
-                 world.grid[newPosition]->getType()!=MOUNT)
+        else if (world.grid.at(newPosition)->getOwner()!=owner &&
+                 world.grid.at(newPosition)->getType()!=MOUNT)
             directories.push_back(newPosition);
     }
+    return directories;
+}
+
+/**
+ * the strategy of this player is random. It chooses the last piece of his pieces and
+ * and checks the possible directions and picks one randomly.
+ * @param world World& the given world
+ * @param owner Owner the player it plays for
+ * @return Action the chosen action
+ * ITEM 3.c the random guy
+ */
+Action actionPlayerZero(World& world, Owner owner) {
+    if (world.units[owner].size()==0) return Action(Position(1,1),Position(1,1));
+    shared_ptr<Piece<char>> chosen = world.units[owner][world.units[owner].size()-1];
+    Position p=chosen->getPos();
+    vector<Position> directories=freeSquares(world,owner,p);
+    // the piece is walled in, there is no legal move for it
+    if (directories.size()==0) return Action(p,p);
     srand(time(0));
     int d=directories.size();
     Action action(p,directories[rand()%d]);
     return action;
 }
 
+/**
+ * the random guy of the free-for-all: every unit that can move goes to a random
+ * free square next to it, so a turn has as many orders as there are units.
+ * @param world World& the given world
+ * @param owner Owner the player it plays for
+ * @return vector<Action> one action for each unit that can move
+ */
+vector<Action> actionsArmy(World& world, Owner owner) {
+    vector<Action> actions;
+    srand(time(0)+owner);
+    for (auto& unit : world.units[owner]) {
+        Position p=unit->getPos();
+        vector<Position> directories=freeSquares(world,owner,p);
+        if (directories.size()==0) continue;
+        actions.push_back(Action(p,directories[rand()%directories.size()]));
+    }
+    return actions;
+}
+
 
 /** @brief
  * the strategy of this player is to first make a defending wall around the flag.
  * then it picks the type that is most available in its units and moves it until
- * it dies or reaches the flag and wins.
+ * it dies or reaches the flag and wins. It expects to start in the bottom right corner.
  * @param world World&
+ * @param owner Owner the player it plays for
  * @return Action
  * ITEM 3.c the strategy guy
  */
-Action actionPlayerOne(World& world) {
+Action actionPlayerOne(World& world, Owner owner) {
     Action action;
     bool found=false;
-    for (int i=0;i<world.units1.size();i++) {
-        Position here=world.units1[i]->getPos();
-        if (here.getAt(0)<13) continue;
+    for (int i=0;i<world.units[owner].size();i++) {
+        Position here=world.units[owner][i]->getPos();
+        if (here.getAt(0)<world.rows-2) continue;
         else {
             Position right(here.getAt(0),here.getAt(1)+1);
-            if (world.grid[right]==NULL && here.getAt(1)+1<=15) {
+            if (world.grid.at(right)==NULL && here.getAt(1)+1<=world.cols) {
                 found=true;
                 action.setFrom(here);
                 Position there(here.getAt(0),here.getAt(1)+1);
@@ -289,13 +511,13 @@ Action actionPlayerOne(World& world) {
     }
     else {
         int r=0,p=0,s=0;
-        for (int i=0;i<world.units1.size();i++) {
-            Position here=world.units1[i]->getPos();
-            if (here.getAt(0)>=13) continue;
+        for (int i=0;i<world.units[owner].size();i++) {
+            Position here=world.units[owner][i]->getPos();
+            if (here.getAt(0)>=world.rows-2) continue;
             else {
-                if (world.units1[i]->getType()==ROCK) r++;
-                if (world.units1[i]->getType()==PAPER) p++;
-                if (world.units1[i]->getType()==SCISSORS) s++;
+                if (world.units[owner][i]->getType()==ROCK) r++;
+                if (world.units[owner][i]->getType()==PAPER) p++;
+                if (world.units[owner][i]->getType()==SCISSORS) s++;
             }
         }
         int a[3]={r,p,s};
@@ -305,26 +527,21 @@ Action actionPlayerOne(World& world) {
         if (a[0]==r) desired=ROCK;
         else if (a[0]==p) desired=PAPER;
         else desired=SCISSORS;
+        // the first unit of the desired type in the order of the rows then the columns
         shared_ptr<Piece<char>> chosen;
-        for (int i=1;i<=15;i++) {
-            for (int j=1;j<=15;j++) {
-                Position here(i,j);
-                if (world.grid[here]==NULL) continue;
-                if (world.grid[here]->getOwner()==ZERO) continue;
-                if (world.grid[here]->getType()==desired) {
-                    chosen=world.grid[here];
-                    found=true;
-                    break;
-                }
+        for (auto& unit : world.units[owner]) {
+            if (unit->getType()!=desired) continue;
+            if (chosen==NULL || unit->getPos()<chosen->getPos()) {
+                chosen=unit;
             }
-            if (found) break;
         }
+        if (chosen==NULL) return Action(Position(1,1),Position(1,1));
         Position pos=chosen->getPos();
         int row=pos.getAt(0),col=pos.getAt(1);
         Position dir(row,col-1);
         if (col-1<1) {
             dir=Position(row-1,col);
-        } else if (world.grid[dir]!=NULL && (world.grid[dir]->getOwner()==ONE || world.grid[dir]->getType()==MOUNT)) {
+        } else if (world.grid.at(dir)!=NULL && (world.grid.at(dir)->getOwner()==owner || world.grid.at(dir)->getType()==MOUNT)) {
             dir=Position(row-1,col);
         }
         action=Action(pos,dir);
@@ -333,11 +550,11 @@ Action actionPlayerOne(World& world) {
 }
 
 /**
- * The return is a pair: action and a boolean whether a timeout happened
+ * The return is a pair: the actions and a boolean whether a timeout happened
  */
-std::tuple<Action, bool> waitPlayer(Action (*f)(World&), World &world) {
+std::tuple<vector<Action>, bool> waitPlayer(vector<Action> (*f)(World&, Owner), Owner owner, World &world) {
     auto start = std::chrono::high_resolution_clock::now();
-    Action action = f(world);
+    vector<Action> action = f(world, owner);
     auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> elapsed = end - start;
     if (elapsed.count() > TIMEOUT)
@@ -348,13 +565,12 @@ std::tuple<Action, bool> waitPlayer(Action (*f)(World&), World &world) {
 /** @brief
  * check if a given position is within the grid
  * @param p Position to check
+ * @param world World&
  * @return bool true if is valid
  *
  */
-bool checkBounds(Position p) {
-    if (p.getAt(0)>=1 && p.getAt(0)<=15 &&
-        p.getAt(1)>=1 && p.getAt(1)<=15) return true;
-    else return false;
+bool checkBounds(Position p, World& world) {
+    return world.inside(p);
 }
 
 /** @brief
@@ -368,8 +584,9 @@ bool checkBounds(Position p) {
  *
  */
 bool checkOwner(Position p, Owner o, World& world, bool flip) {
-    if (world.grid[p]==NULL) return false^flip;
-    if (world.grid[p]->getOwner()==o) return true^flip;
+    shared_ptr<Piece<char>> piece=world.grid.at(p);
+    if (piece==NULL) return false^flip;
+    if (piece->getOwner()==o) return true^flip;
     else return false^flip;
 }
 
@@ -381,8 +598,9 @@ bool checkOwner(Position p, Owner o, World& world, bool flip) {
  *
  */
 bool checkNotMount(Position p, World& world) {
-    if (world.grid[p]==NULL) return true;
-    if (world.grid[p]->getType()==MOUNT) return false;
+    shared_ptr<Piece<char>> piece=world.grid.at(p);
+    if (piece==NULL) return true;
+    if (piece->getType()==MOUNT) return false;
     return true;
 }
 
@@ -395,8 +613,9 @@ bool checkNotMount(Position p, World& world) {
  *
  */
 bool checkNotYourFlag(Position p,Owner owner,World& world) {
-    if (world.grid[p]==NULL) return true;
-    if (world.grid[p]->getType()==FLAG && world.grid[p]->getOwner()==owner) return false;
+    shared_ptr<Piece<char>> piece=world.grid.at(p);
+    if (piece==NULL) return true;
+    if (piece->getType()==FLAG && piece->getOwner()==owner) return false;
     return true;
 }
 
@@ -427,8 +646,8 @@ bool checkDistance(Action action){
 bool validateAction(Action action, Owner owner, World& world) {
     bool valid=true;
     // don't go outside the maze ITEM 3.a.4.b ITEM 1.4.b
-    valid&=checkBounds(action.getFrom());
-    valid&=checkBounds(action.getTo());
+    valid&=checkBounds(action.getFrom(),world);
+    valid&=checkBounds(action.getTo(),world);
     // ITEM 3.a.4.a ITEM 1.4.a move only your units and don't move to one of your units
     // ITEM 3.a.2.c ITEM 1.2.c
     valid&=checkOwner(action.getFrom(),owner,world,false);
@@ -441,126 +660,289 @@ bool validateAction(Action action, Owner owner, World& world) {
     return valid;
 }
 
+/** @brief
+ * check all the actions of a player in one turn. At least one unit has to
+ * move and no unit may move twice.
+ * @param actions vector<Action>
+ * @param owner Owner
+ * @param world World&
+ * @return bool
+ */
+bool validateActions(vector<Action> actions, Owner owner, World& world) {
+    if (actions.empty()) return false;
+    vector<Position> from;
+    for (auto& action : actions) {
+        if (!validateAction(action,owner,world)) return false;
+        from.push_back(action.getFrom());
+    }
+    sort(from.begin(),from.end());
+    return adjacent_find(from.begin(),from.end())==from.end();
+}
+
+/**
+ * true if the first type kills the second one
+ */
 bool operator>(Type t1,Type t2) {
     int x1=t1,x2=t2;
     if (t1==SCISSORS && t2==ROCK) return false;
+    if (t1==ROCK && t2==SCISSORS) return true;
     return x1>x2;
 }
 
 /** @brief
- * update the world given the actions of the two players and return the winner
+ * take a player out of the game with all of its units and its flag
  * @param world World&
- * @param action0 Action
- * @param action1 Action
- * @param tie bool& becomes true if they tied
- * @return Owner the winner if someone won
- * ITEM 3.a.4 ITEM 1.4 all the movement rules in the update function and validateAction function
+ * @param owner Owner
+ * @return void
  */
-Owner update(World& world, Action action0 ,Action action1,bool &tie) {
-    // ITEM 3.a.3.d ITEM 1.3.d first check if one of the players or both of them reached the flags
-    Position f(1,1);
-    Position F(15,15);
-    if (action0.getTo()==F && action1.getTo()==f){
-        tie=true;
-        return NA;
-    }
-    if (action0.getTo()==F) return ZERO;
-    if (action1.getTo()==f) return ONE;
-    // in case both of the players moved to the same position
-    if (action0.getTo()==action1.getTo()) {
-        // ITEM 3.a.4.e ITEM 1.4.e if they have the same type do nothing (bounce back in other words)
-        if (world.grid[action0.getFrom()]->getType()==
-                world.grid[action1.getFrom()]->getType()) {
-            return NA;
-        }
-        // if the player0's unit is stronger kill the other one and move the
-        // first to to the desired position
-        // ITEM 3.a.4.g ITEM 1.4.g (killing)
-        else if (world.grid[action0.getFrom()]->getType()>
-                 world.grid[action1.getFrom()]->getType()) {
-            world.grid[action0.getFrom()]->setPos(action0.getTo());
-            world.grid[action0.getTo()]=world.grid[action0.getFrom()];
-            world.grid[action0.getFrom()]=NULL;
-            for (int i=0;i<world.units1.size();i++) {
-                if (world.units1[i]==world.grid[action1.getFrom()]) {
-                    world.units1.erase(world.units1.begin()+i);
-                }
-            }
-            world.grid[action1.getFrom()]=NULL;
-            // else make the player1's piece kill and move
-        } else {
-            world.grid[action1.getFrom()]->setPos(action1.getTo());
-            world.grid[action1.getTo()]=world.grid[action1.getFrom()];
-            world.grid[action1.getFrom()]=NULL;
-            for (int i=0;i<world.units0.size();i++) {
-                if (world.units0[i]==world.grid[action0.getFrom()]) {
-                    world.units0.erase(world.units0.begin()+i);
-                }
+void eliminate(World& world, Owner owner) {
+    for (auto& piece : world.units[owner]) {
+        world.grid.set(piece->getPos(),NULL);
+    }
+    world.units[owner].clear();
+    if (checkOwner(world.flags[owner],owner,world,false)) {
+        world.grid.set(world.flags[owner],NULL);
+    }
+    world.alive[owner]=false;
+}
+
+/**
+ * what happened to the pieces in one part of the board during a turn
+ */
+class Outcome {
+public:
+    vector<shared_ptr<Piece<char>>> dead;
+    vector<tuple<shared_ptr<Piece<char>>,Position>> moves;
+};
+
+/** @brief
+ * resolve the fights between the attackers of the same square for the orders
+ * that target one part of the board. The world is only read here so that the
+ * parts of the board can be resolved at the same time.
+ * @param world World&
+ * @param orders vector<tuple<Owner,Action>>& valid orders, sorted here by target
+ * @param out Outcome& the attackers that die and the lone attacker left on each
+ * square, which still has to get past the occupant of the square in advance()
+ * ITEM 3.a.4 ITEM 1.4
+ */
+void resolve(World& world, vector<tuple<Owner,Action>>& orders, Outcome& out) {
+    sort(orders.begin(),orders.end(),[](tuple<Owner,Action>& a,tuple<Owner,Action>& b) {
+        return get<1>(a).getTo()<get<1>(b).getTo();
+    });
+    for (size_t i=0,j=0;i<orders.size();i=j) {
+        Position to=get<1>(orders[i]).getTo();
+        vector<shared_ptr<Piece<char>>> attackers;
+        while (j<orders.size() && get<1>(orders[j]).getTo()==to) {
+            attackers.push_back(world.grid.at(get<1>(orders[j]).getFrom()));
+            j++;
+        }
+        // ITEM 3.a.4.g ITEM 1.4.g an attacker dies if another player's attacker of
+        // the same square kills its type
+        vector<shared_ptr<Piece<char>>> survivors;
+        for (size_t k=0;k<attackers.size();k++) {
+            bool killed=false;
+            for (size_t m=0;m<attackers.size() && !killed;m++) {
+                killed=attackers[m]->getOwner()!=attackers[k]->getOwner() &&
+                       attackers[m]->getType()>attackers[k]->getType();
             }
-            world.grid[action0.getFrom()]=NULL;
+            if (killed) out.dead.push_back(attackers[k]);
+            else survivors.push_back(attackers[k]);
         }
-    } else {
-        // each one goes to a different position
-        if (world.grid[action0.getTo()]==NULL) {
-            world.grid[action0.getFrom()]->setPos(action0.getTo());
-            world.grid[action0.getTo()]=world.grid[action0.getFrom()];
-            world.grid[action0.getFrom()]=NULL;
+        // ITEM 3.a.4.e ITEM 1.4.e more than one survivor means they have the same
+        // type, so they all bounce back
+        if (survivors.size()!=1) continue;
+        out.moves.push_back({survivors[0],to});
+    }
+}
+
+/** @brief
+ * decide which of the lone attackers get into their squares. The occupant of a
+ * square only defends it if it stays: it has no order, it bounced, or its own
+ * move failed. An occupant that leaves lets the attacker in, and two units that
+ * swap squares meet head on. The moves are followed along the chains of units
+ * walking behind each other, and a closed ring of them all moves.
+ * @param world World&
+ * @param outcomes vector<Outcome>& what resolve() found in every part
+ * @param out Outcome& the units killed by occupants or head on, and the moves
+ * that really happen
+ * ITEM 3.a.4 ITEM 1.4
+ */
+void advance(World& world, vector<Outcome>& outcomes, Outcome& out) {
+    enum {UNKNOWN,VISITING,MOVED,STAYED};
+    unordered_map<Piece<char>*,Position> target;
+    unordered_set<Piece<char>*> dead;
+    for (auto& part : outcomes) {
+        for (auto& piece : part.dead) {
+            dead.insert(piece.get());
         }
-        else {
-            if (world.grid[action0.getFrom()]->getType()==
-                    world.grid[action0.getTo()]->getType()) {
+        for (auto& [piece,to] : part.moves) {
+            target[piece.get()]=to;
+        }
+    }
+    unordered_map<Piece<char>*,int> state;
+    // the attacker meets an occupant that stays on the square, or NULL if there is none
+    auto fight=[&](shared_ptr<Piece<char>> attacker,shared_ptr<Piece<char>> occupant) {
+        if (occupant==NULL || dead.count(occupant.get())) return MOVED;
+        if (occupant->getOwner()==attacker->getOwner() ||
+            occupant->getType()==attacker->getType()) return STAYED;
+        if (attacker->getType()>occupant->getType()) {
+            dead.insert(occupant.get());
+            out.dead.push_back(occupant);
+            return MOVED;
+        }
+        dead.insert(attacker.get());
+        out.dead.push_back(attacker);
+        return STAYED;
+    };
+    for (auto& part : outcomes) {
+        for (auto& move : part.moves) {
+            if (state[get<0>(move).get()]!=UNKNOWN) continue;
+            // walk to the front of the chain, then settle it from the front back
+            vector<shared_ptr<Piece<char>>> path;
+            shared_ptr<Piece<char>> cur=get<0>(move);
+            int result;
+            while (true) {
+                state[cur.get()]=VISITING;
+                path.push_back(cur);
+                shared_ptr<Piece<char>> occupant=world.grid.at(target[cur.get()]);
+                if (occupant==NULL || !target.count(occupant.get())) {
+                    result=fight(cur,occupant);
+                    break;
+                }
+                if (target[occupant.get()]==cur->getPos()) {
+                    // head on: the stronger one moves and the weaker one dies
+                    result=STAYED;
+                    state[occupant.get()]=STAYED;
+                    if (occupant->getOwner()==cur->getOwner() || occupant->getType()==cur->getType()) {
 
-            }
-            else if (world.grid[action0.getFrom()]->getType()>
-                     world.grid[action0.getTo()]->getType()) {
-                world.grid[action0.getFrom()]->setPos(action0.getTo());
-                world.grid[action0.getTo()]=world.grid[action0.getFrom()];
-                world.grid[action0.getFrom()]=NULL;
-                for (int i=0;i<world.units1.size();i++) {
-                    if (world.units1[i]==world.grid[action0.getTo()]) {
-                        world.units1.erase(world.units1.begin()+i);
                     }
-                }
-            } else {
-                for (int i=0;i<world.units0.size();i++) {
-                    if (world.units0[i]==world.grid[action0.getFrom()]) {
-                        world.units0.erase(world.units0.begin()+i);
+                    else if (cur->getType()>occupant->getType()) {
+                        dead.insert(occupant.get());
+                        out.dead.push_back(occupant);
+                        result=MOVED;
+                    } else {
+                        dead.insert(cur.get());
+                        out.dead.push_back(cur);
+                        state[occupant.get()]=MOVED;
                     }
+                    break;
                 }
-                world.grid[action0.getFrom()]=NULL;
+                int next=state[occupant.get()];
+                if (next==VISITING || next==MOVED) {
+                    result=MOVED;
+                    break;
+                }
+                if (next==STAYED) {
+                    result=fight(cur,occupant);
+                    break;
+                }
+                cur=occupant;
+            }
+            state[path.back().get()]=result;
+            for (size_t i=path.size()-1;i>0;i--) {
+                shared_ptr<Piece<char>> front=path[i];
+                state[path[i-1].get()]=state[front.get()]==MOVED ? MOVED : fight(path[i-1],front);
             }
         }
-
-        if (world.grid[action1.getTo()]==NULL) {
-            world.grid[action1.getFrom()]->setPos(action1.getTo());
-            world.grid[action1.getTo()]=world.grid[action1.getFrom()];
-            world.grid[action1.getFrom()]=NULL;
+    }
+    for (auto& part : outcomes) {
+        for (auto& move : part.moves) {
+            if (state[get<0>(move).get()]==MOVED) out.moves.push_back(move);
         }
-        else {
-            if (world.grid[action1.getFrom()]->getType()==
-                    world.grid[action1.getTo()]->getType()) {
+    }
+}
 
-            }
-            else if (world.grid[action1.getFrom()]->getType()>
-                     world.grid[action1.getTo()]->getType()) {
-                world.grid[action1.getFrom()]->setPos(action1.getTo());
-                world.grid[action1.getTo()]=world.grid[action1.getFrom()];
-                world.grid[action1.getFrom()]=NULL;
-                for (int i=0;i<world.units0.size();i++) {
-                    if (world.units0[i]==world.grid[action1.getTo()]) {
-                        world.units0.erase(world.units0.begin()+i);
-                    }
-                }
-            } else {
-                for (int i=0;i<world.units1.size();i++) {
-                    if (world.units1[i]==world.grid[action1.getFrom()]) {
-                        world.units1.erase(world.units1.begin()+i);
-                    }
-                }
-                world.grid[action1.getFrom()]=NULL;
-            }
+/** @brief
+ * update the world given the valid orders of the players and return the winner.
+ * With two players capturing the flag wins the game, with more players it only
+ * knocks the owner of the flag out and the capturer moves onto the empty square.
+ * The orders are split by the chunk of the board they target, and the fights
+ * between the attackers of the same square are resolved in parallel when there
+ * are many of them. Following the chains in advance() and writing the board
+ * happen on the calling thread.
+ * @param world World&
+ * @param orders vector<tuple<Owner,Action>> the owner and the action of every order,
+ * a piece can be moved by one order at most
+ * @param tie bool& becomes true if both players of a two player game captured a flag
+ * @param parts int how many parts to resolve at the same time, 0 picks it from
+ * the number of orders and the number of cores
+ * @return Owner the winner if someone won
+ * ITEM 3.a.4 ITEM 1.4 all the movement rules in the update function and validateAction function
+ */
+Owner update(World& world, vector<tuple<Owner,Action>> orders, bool &tie, int parts=0) {
+    // ITEM 3.a.3.d ITEM 1.3.d first check if some players reached the flags
+    Owner winner=NA;
+    vector<Owner> captured;
+    for (auto& [owner,action] : orders) {
+        shared_ptr<Piece<char>> target=world.grid.at(action.getTo());
+        if (target==NULL || target->getType()!=FLAG || target->getOwner()==owner) continue;
+        if (winner!=NA && winner!=owner) tie=true;
+        winner=owner;
+        captured.push_back(target->getOwner());
+    }
+    if (world.players==2) {
+        if (tie) return NA;
+        if (winner!=NA) return winner;
+    }
+    tie=false;
+    for (Owner o : captured) {
+        if (world.alive[o]) eliminate(world,o);
+    }
+    // the players that lost their flag don't move anymore
+    orders.erase(remove_if(orders.begin(),orders.end(),[&world](tuple<Owner,Action>& order) {
+        return !world.alive[get<0>(order)];
+    }),orders.end());
+    // the orders that target the same square land in the same part
+    if (parts==0) {
+        parts=1;
+        if (orders.size()>=PARALLEL_ORDERS) parts=max(1u,thread::hardware_concurrency());
+    }
+    vector<vector<tuple<Owner,Action>>> buckets(parts);
+    for (auto& order : orders) {
+        unsigned long long chunk=Grid::chunkOf(get<1>(order).getTo());
+        buckets[hash<unsigned long long>()(chunk)%parts].push_back(order);
+    }
+    vector<Outcome> outcomes(parts);
+    vector<thread> workers;
+    for (int i=1;i<parts;i++) {
+        workers.emplace_back(resolve,ref(world),ref(buckets[i]),ref(outcomes[i]));
+    }
+    resolve(world,buckets[0],outcomes[0]);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    Outcome last;
+    advance(world,outcomes,last);
+    outcomes.push_back(last);
+    // remove the dead, a piece may die in more than one fight
+    vector<bool> touched(world.players,false);
+    for (auto& outcome : outcomes) {
+        for (auto& piece : outcome.dead) {
+            if (world.grid.at(piece->getPos())!=piece) continue;
+            world.grid.set(piece->getPos(),NULL);
+            touched[piece->getOwner()]=true;
         }
     }
+    // the pieces that survived leave their squares before any of them arrives
+    vector<tuple<shared_ptr<Piece<char>>,Position>> moves;
+    for (auto& move : last.moves) {
+        shared_ptr<Piece<char>> piece=get<0>(move);
+        if (world.grid.at(piece->getPos())!=piece) continue;
+        world.grid.set(piece->getPos(),NULL);
+        moves.push_back(move);
+    }
+    for (auto& [piece,to] : moves) {
+        piece->setPos(to);
+        world.grid.set(to,piece);
+    }
+    // a unit that is no longer on its square is dead
+    for (Owner o=0;o<world.players;o++) {
+        if (!touched[o]) continue;
+        vector<shared_ptr<Piece<char>>> &u=world.units[o];
+        u.erase(remove_if(u.begin(),u.end(),[&world](shared_ptr<Piece<char>>& piece) {
+            return world.grid.at(piece->getPos())!=piece;
+        }),u.end());
+    }
     // no one won
     return NA;
 }
@@ -568,27 +950,26 @@ Owner update(World& world, Action action0 ,Action action1,bool &tie) {
 /** @brief
  * show which player has more advantage using a bar,
  * depending on the manhattan distance between the flag
- * and the closest opponent.
+ * and the closest opponent. Only for games of two players.
  * @param world World&
  * @return void
  * ITEM 3.d the advantage of each player using a bar
  */
 void advantage(World& world) {
-    int mn0=30,mn1=30;
+    if (world.players!=2) return;
+    Position f=world.flags[ZERO];
+    Position F=world.flags[ONE];
+    int mn0=abs(F.getAt(0)-f.getAt(0))+abs(F.getAt(1)-f.getAt(1));
+    int mn1=mn0;
     // mn0 is the manhattan distance between the flag0 and the closest piece of one
     // same for mn1
-    for (int i=1;i<=15;i++) {
-        for (int j=1;j<=15;j++) {
-            Position cur(i,j);
-            if (world.grid[cur]!=NULL) {
-                if (world.grid[cur]->getOwner()==ONE) {
-                    mn0=min(mn0,i-1+j-1);
-                }
-                if (world.grid[cur]->getOwner()==ZERO) {
-                    mn1=min(mn1,15-i+15-j);
-                }
-            }
-        }
+    for (auto& piece : world.units[ONE]) {
+        Position cur=piece->getPos();
+        mn0=min(mn0,abs(cur.getAt(0)-f.getAt(0))+abs(cur.getAt(1)-f.getAt(1)));
+    }
+    for (auto& piece : world.units[ZERO]) {
+        Position cur=piece->getPos();
+        mn1=min(mn1,abs(cur.getAt(0)-F.getAt(0))+abs(cur.getAt(1)-F.getAt(1)));
     }
     // calculate the fraction on a scale from 1 to 20
     int sum=mn0+mn1;
@@ -602,68 +983,121 @@ void advantage(World& world) {
     cout<<" Player one\n\n";
 }
 
-int main() {
+#ifndef RPS_NO_MAIN
+/**
+ * read a whole argument as a number
+ * @param s const char* the argument
+ * @param x int& the number
+ * @return bool false if the argument is not a number
+ */
+bool readNumber(const char* s, int& x) {
+    char* end;
+    long value=strtol(s,&end,10);
+    if (*s=='\0' || *end!='\0' || value<INT_MIN || value>INT_MAX) return false;
+    x=value;
+    return true;
+}
+
+/**
+ * with no arguments the classic game of the random guy against the strategy guy,
+ * with "players rows cols units [seed]" a free-for-all of random armies on a big board
+ */
+int main(int argc, char* argv[]) {
     World world;
+    vector<vector<Action> (*)(World&, Owner)> strategies={
+        [](World& w, Owner o) { return vector<Action>{actionPlayerZero(w,o)}; },
+        [](World& w, Owner o) { return vector<Action>{actionPlayerOne(w,o)}; }
+    };
+    if (argc>=5) {
+        int n,r,c,u,seed=time(0);
+        bool numbers=readNumber(argv[1],n) && readNumber(argv[2],r) && readNumber(argv[3],c) &&
+                     readNumber(argv[4],u) && (argc<6 || readNumber(argv[5],seed));
+        if (!numbers || n<2 || r<1 || c<1 || u<1) {
+            cout<<"usage: "<<argv[0]<<" <players> <rows> <cols> <units per player> [seed]\n";
+            cout<<"\tat least 2 players, and at least 1 row, column and unit per player\n";
+            return 1;
+        }
+        if (4LL*n*(u+1)>1LL*r*c) {
+            cout<<"the board is too small for so many players and units\n";
+            return 1;
+        }
+        world=World(n,r,c,u,seed);
+        strategies.assign(n,actionsArmy);
+    }
     world.show();
     bool endGame = false;
     while (!endGame) {
         // ITEM 1.3 ITEM 3.a.3
-        auto[action0, timeout0] = waitPlayer( actionPlayerZero, world);
-        auto[action1, timeout1] = waitPlayer( actionPlayerOne , world);
-        if (timeout0 || timeout1) {
-            endGame = true;
-            if (timeout0 && !timeout1) {
-                cout<<"\n\tTime is over for player zero\n";
-                cout<<"\tPlayer one won\n";
+        vector<vector<Action>> actions(world.players);
+        vector<bool> timeouts(world.players,false);
+        for (Owner o=0;o<world.players;o++) {
+            if (!world.alive[o]) continue;
+            bool timeout;
+            tie(actions[o],timeout) = waitPlayer(strategies[o], o, world);
+            timeouts[o]=timeout;
+        }
+        // ITEM 3.a.4.f ITEM 1.4.f A player immediately loses if attempted to make an illegal move
+        vector<Owner> out;
+        for (Owner o=0;o<world.players;o++) {
+            if (!world.alive[o]) continue;
+            if (timeouts[o]) {
+                cout<<"\n\tTime is over for player "<<playerName(o)<<"\n";
+                out.push_back(o);
             }
-            if (!timeout0 && timeout1) {
-                cout<<"\n\tTime is over for player one\n";
-                cout<<"\tPlayer zero won\n";
+            else if (!validateActions(actions[o],o,world)) {
+                cout<<"\n\tPlayer "<<playerName(o)<<" played illegal move\n";
+                out.push_back(o);
             }
-            if (timeout0 && timeout1) {
-                cout<<"\n\tTIE\n";
-                cout<<"\tBoth of the players used all their times\n";
+        }
+        for (Owner o : out) {
+            eliminate(world,o);
+        }
+        vector<tuple<Owner,Action>> orders;
+        for (Owner o=0;o<world.players;o++) {
+            if (!world.alive[o]) continue;
+            for (auto& action : actions[o]) {
+                orders.push_back({o,action});
             }
-        } else {
-            // ITEM 3.a.4.f ITEM 1.4.f A player immediately loses if attempted to make an illegal move
-            bool invalid0=!validateAction(action0,ZERO,world);
-            bool invalid1=!validateAction(action1,ONE,world);
-            if (invalid0 || invalid1) {
-                endGame=true;
-                if (invalid0 && !invalid1) {
-                    cout<<"\n\tPlayer zero played illegal move\n";
-                    cout<<"\tPlayer one won\n";
-                }
-                if (!invalid0 && invalid1) {
-                    cout<<"\n\tPlayer one played illegal move\n";
-                    cout<<"\tPlayer zero won\n";
-                }
-                if (invalid0 && invalid1) {
-                    cout<<"\n\tTIE\n";
-                    cout<<"\tBoth of the players played illegal moves\n";
+        }
+        bool tie=false;
+        Owner winner=NA;
+        if (count(world.alive.begin(),world.alive.end(),true)>1) {
+            vector<bool> before=world.alive;
+            winner = update(world,orders,tie);
+            for (Owner o=0;o<world.players;o++) {
+                if (before[o] && !world.alive[o]) {
+                    cout<<"\n\tThe flag of player "<<playerName(o)<<" was captured\n";
                 }
             }
-            bool tie=false;
-            Owner winner = update(world,action0,action1,tie);
-            if (tie) {
-                cout<<"\n\tTie\tBoth players captured the flag at the same time\n";
-                endGame=true;
-            }
-            else if (winner==ZERO) {
-                cout<<"\n\tPlayer zero won by capturing the flag\n";
-                endGame=true;
-            }
-            else if (winner==ONE) {
-                cout<<"\n\tPlayer one won by capturing the flag\n";
-                endGame=true;
-            }
-            else {
-                world.show();
-                advantage(world);
-                // ITEM 3.a.3 ITEM 1.3 once per second
-                this_thread::sleep_for(1000ms);
-            }
+        }
+        vector<Owner> left;
+        for (Owner o=0;o<world.players;o++) {
+            if (world.alive[o]) left.push_back(o);
+        }
+        if (tie) {
+            cout<<"\n\tTie\tBoth players captured the flag at the same time\n";
+            endGame=true;
+        }
+        else if (winner!=NA) {
+            cout<<"\n\tPlayer "<<playerName(winner)<<" won by capturing the flag\n";
+            endGame=true;
+        }
+        else if (left.size()==1) {
+            cout<<"\tPlayer "<<playerName(left[0])<<" won\n";
+            endGame=true;
+        }
+        else if (left.size()==0) {
+            cout<<"\n\tTIE\n";
+            cout<<"\tAll of the players are out\n";
+            endGame=true;
+        }
+        else {
+            world.show();
+            advantage(world);
+            // ITEM 3.a.3 ITEM 1.3 once per second
+            this_thread::sleep_for(1000ms);
         }
     }
     return 0;
 }
+#endif